@@ -4,5 +4,6 @@
 
 COMPONENT_SRCDIRS := .
 COMPONENT_ADD_INCLUDEDIRS := include
+COMPONENT_PRIV_INCLUDEDIRS := private_include
 
-COMPONENT_DEPENDS := mdns esp_wifi esp_netif esp_event nvs_flash
+COMPONENT_DEPENDS := mdns esp_wifi esp_netif esp_event esp_timer nvs_flash
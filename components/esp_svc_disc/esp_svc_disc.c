@@ -1,10 +1,15 @@
 #include "esp_svc_disc.h"
+#include "esp_svc_disc_priv.h"
 #include "esp_log.h"
 #include "esp_eth.h"
 #include "esp_netif.h"
+#include "esp_random.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
+#include <stdatomic.h>
+#include <stdlib.h>
 #include <string.h>
 
 static const char *TAG = "ESP_SVC_DISC";
@@ -18,6 +23,299 @@ static bool s_discovery_running = false;
 static EventGroupHandle_t s_discovery_event_group = NULL;
 #define DISCOVERY_STOP_BIT BIT0
 
+// Endpoint selection: weights are scaled by RTT_REF_MS / (rtt + RTT_REF_MS)
+#define ENDPOINT_RTT_REF_MS     10
+#define ENDPOINT_MAX_LOAD       100
+#define ENDPOINT_PICK_RETRIES   3
+
+// Table readers spin this often on a slot being written before yielding;
+// a write is a short memcpy, usually done by the writer on the other core
+#define SVC_TABLE_READ_SPINS    100
+
+// mDNS repeats an unanswered question about once a second, so a shorter
+// unicast window sends exactly one QU question
+#define QUERY_QU_WINDOW_MS      500
+
+// Discovered-service table. Each slot is guarded by its own sequence lock:
+// the discovery task is the only writer, readers copy a slot out and retry
+// if its sequence was odd (write in progress) or changed during the copy.
+typedef struct {
+    atomic_uint seq;
+    bool in_use;
+    esp_svc_disc_service_t service;
+} svc_table_slot_t;
+
+static svc_table_slot_t s_service_table[CONFIG_ESP_SVC_DISC_MAX_SERVICES];
+
+static void svc_table_write_slot(svc_table_slot_t *slot, const esp_svc_disc_service_t *service)
+{
+    unsigned int seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+    atomic_store_explicit(&slot->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    
+    slot->in_use = (service != NULL);
+    if (service) {
+        memcpy(&slot->service, service, sizeof(slot->service));
+    }
+    
+    atomic_store_explicit(&slot->seq, seq + 2, memory_order_release);
+}
+
+static bool svc_table_read_slot(const svc_table_slot_t *slot, esp_svc_disc_service_t *out)
+{
+    int spins = 0;
+    while (true) {
+        unsigned int seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        if (seq & 1) {
+            // Writer is mid-update. Spin while it finishes on the other core, then
+            // sleep so a lower-priority writer on this core can run
+            if (++spins >= SVC_TABLE_READ_SPINS) {
+                spins = 0;
+                vTaskDelay(1);
+            }
+            continue;
+        }
+        
+        bool in_use = slot->in_use;
+        if (in_use) {
+            memcpy(out, &slot->service, sizeof(*out));
+        }
+        
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&slot->seq, memory_order_relaxed) == seq) {
+            return in_use;
+        }
+    }
+}
+
+static bool svc_table_matches(const esp_svc_disc_service_t *service, const char *instance_name,
+                              const char *service_type, const char *protocol)
+{
+    return (!instance_name || strcmp(service->instance_name, instance_name) == 0) &&
+           (!service_type || strcmp(service->service_type, service_type) == 0) &&
+           (!protocol || strcmp(service->protocol, protocol) == 0);
+}
+
+static uint32_t svc_now_ms(void)
+{
+    return (uint32_t)(xTaskGetTickCount() * portTICK_PERIOD_MS);
+}
+
+// Entries not refreshed by a browse within the max age are treated as gone
+static bool svc_table_fresh(uint32_t last_seen_ms, uint32_t now_ms)
+{
+#if CONFIG_ESP_SVC_DISC_SERVICE_MAX_AGE_MS > 0
+    return (uint32_t)(now_ms - last_seen_ms) <= CONFIG_ESP_SVC_DISC_SERVICE_MAX_AGE_MS;
+#else
+    return true;
+#endif
+}
+
+static uint32_t txt_get_uint(const mdns_txt_item_t *txt, size_t txt_count, const char *key,
+                             uint32_t def, uint32_t max)
+{
+    for (size_t i = 0; txt && i < txt_count; i++) {
+        if (txt[i].key && txt[i].value && strcmp(txt[i].key, key) == 0) {
+            unsigned long value = strtoul(txt[i].value, NULL, 10);
+            return value > max ? max : (uint32_t)value;
+        }
+    }
+    return def;
+}
+
+// Writer side only: called from the discovery task, so slots can be read directly
+void esp_svc_disc_table_update(const mdns_result_t *r, const char *service_type, const char *protocol,
+                               const char *hostname, uint16_t port, uint32_t rtt_sample_ms)
+{
+    svc_table_slot_t *target = NULL;
+    svc_table_slot_t *oldest = NULL;
+    bool existing = false;
+    
+    // A truncated name would never match its own entry again and is useless to callers
+    if (strlen(r->instance_name) >= sizeof(target->service.instance_name) ||
+        strlen(service_type) >= sizeof(target->service.service_type) ||
+        strlen(protocol) >= sizeof(target->service.protocol) ||
+        strlen(hostname) >= sizeof(target->service.hostname)) {
+        ESP_LOGW(TAG, "Not caching %s at %s: name too long", r->instance_name, hostname);
+        return;
+    }
+    
+    for (size_t i = 0; i < CONFIG_ESP_SVC_DISC_MAX_SERVICES; i++) {
+        svc_table_slot_t *slot = &s_service_table[i];
+        if (!slot->in_use) {
+            if (!target) {
+                target = slot;
+            }
+            continue;
+        }
+        if (svc_table_matches(&slot->service, r->instance_name, service_type, protocol)) {
+            target = slot;
+            existing = true;
+            break;
+        }
+        if (!oldest || (int32_t)(slot->service.last_seen_ms - oldest->service.last_seen_ms) < 0) {
+            oldest = slot;
+        }
+    }
+    if (!target) {
+        ESP_LOGD(TAG, "Service table full, replacing %s", oldest->service.instance_name);
+        target = oldest;
+    }
+    
+    // Rolling RTT estimate: srtt += (sample - srtt) / 8, as for TCP
+    uint32_t rtt_ms = existing ? target->service.rtt_ms : 0;
+    if (rtt_sample_ms) {
+        rtt_ms = rtt_ms ? (uint32_t)((int32_t)rtt_ms + ((int32_t)rtt_sample_ms - (int32_t)rtt_ms) / 8) : rtt_sample_ms;
+    }
+    
+    esp_svc_disc_service_t service = {0};
+    strlcpy(service.instance_name, r->instance_name, sizeof(service.instance_name));
+    strlcpy(service.service_type, service_type, sizeof(service.service_type));
+    strlcpy(service.protocol, protocol, sizeof(service.protocol));
+    strlcpy(service.hostname, hostname, sizeof(service.hostname));
+    service.port = port;
+    service.priority = (uint16_t)txt_get_uint(r->txt, r->txt_count, "priority", 0, UINT16_MAX);
+    service.weight = (uint16_t)txt_get_uint(r->txt, r->txt_count, "weight", 0, UINT16_MAX);
+    service.load = (uint8_t)txt_get_uint(r->txt, r->txt_count, "load", 0, ENDPOINT_MAX_LOAD);
+    service.rtt_ms = rtt_ms;
+    service.last_seen_ms = svc_now_ms();
+    
+    svc_table_write_slot(target, &service);
+}
+
+// A writer deleted mid-update leaves an odd sequence; drop the torn entry and
+// close the sequence so readers don't stall. Only call with no writer running.
+static void svc_table_repair(void)
+{
+    for (size_t i = 0; i < CONFIG_ESP_SVC_DISC_MAX_SERVICES; i++) {
+        svc_table_slot_t *slot = &s_service_table[i];
+        if (atomic_load_explicit(&slot->seq, memory_order_relaxed) & 1) {
+            slot->in_use = false;
+            atomic_fetch_add_explicit(&slot->seq, 1, memory_order_release);
+        }
+    }
+}
+
+static void svc_table_clear(void)
+{
+    svc_table_repair();
+    for (size_t i = 0; i < CONFIG_ESP_SVC_DISC_MAX_SERVICES; i++) {
+        svc_table_slot_t *slot = &s_service_table[i];
+        if (slot->in_use) {
+            svc_table_write_slot(slot, NULL);
+        }
+    }
+}
+
+static void svc_disc_answer_time(int64_t start_us, uint32_t *answer_ms)
+{
+    if (answer_ms) {
+        // Round up so a measured sample is never 0 ("unknown")
+        *answer_ms = (uint32_t)((esp_timer_get_time() - start_us + 999) / 1000);
+    }
+}
+
+#if CONFIG_ESP_SVC_DISC_QUERY_UNICAST_FIRST
+static bool str_equal(const char *a, const char *b)
+{
+    return (a == NULL || b == NULL) ? a == b : strcmp(a, b) == 0;
+}
+
+// The same answer from both query legs: same instance (or host) on the same interface and IP protocol
+static bool svc_result_same(const mdns_result_t *a, const mdns_result_t *b)
+{
+    if (a->esp_netif != b->esp_netif || a->ip_protocol != b->ip_protocol) {
+        return false;
+    }
+    return (a->instance_name || b->instance_name) ? str_equal(a->instance_name, b->instance_name)
+                                                  : str_equal(a->hostname, b->hostname);
+}
+
+// Fold the QU answers into the QM ones. A QM answer wins over its QU twin
+// unless only the QU one carries a hostname.
+static mdns_result_t *svc_results_merge(mdns_result_t *qm, mdns_result_t *qu)
+{
+    while (qu) {
+        mdns_result_t *next = qu->next;
+        qu->next = NULL;
+        
+        mdns_result_t **twin = &qm;
+        while (*twin && !svc_result_same(*twin, qu)) {
+            twin = &(*twin)->next;
+        }
+        
+        if (!*twin) {
+            qu->next = qm;
+            qm = qu;
+        } else if (!(*twin)->hostname && qu->hostname) {
+            mdns_result_t *old = *twin;
+            qu->next = old->next;
+            old->next = NULL;
+            *twin = qu;
+            mdns_query_results_free(old);
+        } else {
+            mdns_query_results_free(qu);
+        }
+        qu = next;
+    }
+    return qm;
+}
+#endif
+
+/**
+ * Run an mDNS query. With CONFIG_ESP_SVC_DISC_QUERY_UNICAST_FIRST a single
+ * QU question goes out first so responders can answer this device directly,
+ * then a QM query collects answers for the rest of the timeout and both
+ * answer sets are merged. The QM leg is skipped when the QU leg already
+ * filled max_results, so a resolve answered over unicast returns at once.
+ */
+static esp_err_t svc_disc_query(const char *name, const char *service_type, const char *protocol,
+                                uint16_t type, uint32_t timeout_ms, size_t max_results,
+                                mdns_result_t **results, uint32_t *answer_ms)
+{
+    mdns_result_t *qu_results = NULL;
+#if CONFIG_ESP_SVC_DISC_QUERY_UNICAST_FIRST
+    uint32_t qu_timeout_ms = timeout_ms < QUERY_QU_WINDOW_MS ? timeout_ms : QUERY_QU_WINDOW_MS;
+    int64_t qu_start_us = esp_timer_get_time();
+    esp_err_t err = mdns_query_generic(name, service_type, protocol, type, MDNS_QUERY_UNICAST,
+                                       qu_timeout_ms, max_results, &qu_results);
+    if (err != ESP_OK) {
+        ESP_LOGD(TAG, "Unicast query for %s%s failed: %s", service_type, protocol, esp_err_to_name(err));
+        qu_results = NULL;
+    }
+    
+    size_t qu_count = 0;
+    for (mdns_result_t *r = qu_results; r; r = r->next) {
+        qu_count++;
+    }
+    if (qu_results) {
+        svc_disc_answer_time(qu_start_us, answer_ms);
+    }
+    if (qu_count >= max_results || timeout_ms <= qu_timeout_ms) {
+        *results = qu_results;
+        return err;
+    }
+    timeout_ms -= qu_timeout_ms;
+#endif
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t ret = mdns_query_generic(name, service_type, protocol, type, MDNS_QUERY_MULTICAST,
+                                       timeout_ms, max_results, results);
+    if (ret != ESP_OK) {
+        *results = NULL;
+    } else if (*results && !qu_results) {
+        // Only the leg that was answered counts towards the response time
+        svc_disc_answer_time(start_us, answer_ms);
+    }
+    
+#if CONFIG_ESP_SVC_DISC_QUERY_UNICAST_FIRST
+    *results = svc_results_merge(*results, qu_results);
+    if (*results) {
+        ret = ESP_OK;
+    }
+#endif
+    return ret;
+}
+
 static void discovery_task(void *pvParameters)
 {
     esp_svc_disc_config_t *config = (esp_svc_disc_config_t *)pvParameters;
@@ -25,13 +323,18 @@ static void discovery_task(void *pvParameters)
     ESP_LOGI(TAG, "Starting service discovery for %s%s", config->service_type, config->protocol);
     
     mdns_result_t *results = NULL;
-    esp_err_t err = mdns_query_ptr(config->service_type, config->protocol, config->timeout_ms, 20, &results);
+    esp_err_t err = svc_disc_query(NULL, config->service_type, config->protocol, MDNS_TYPE_PTR,
+                                   config->timeout_ms, CONFIG_ESP_SVC_DISC_MAX_RESULTS, &results, NULL);
     
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "mDNS query failed: %s", esp_err_to_name(err));
         goto cleanup;
     }
     
+    // Resolves share a budget of one browse timeout, so a large or lossy browse
+    // can't keep the task busy indefinitely
+    int64_t resolve_deadline_us = esp_timer_get_time() + (int64_t)config->timeout_ms * 1000;
+    
     mdns_result_t *r = results;
     while (r) {
         // Check if we should stop
@@ -41,9 +344,40 @@ static void discovery_task(void *pvParameters)
             break;
         }
         
-        if (r->hostname && config->callback) {
-            ESP_LOGI(TAG, "Found service: %s at %s:%d", r->instance_name, r->hostname, r->port);
-            config->callback(r->instance_name, r->hostname, r->port, r->txt, r->txt_count, config->user_data);
+        // Resolve instances whose SRV record was not part of the browse answer. A
+        // targeted query completes on the first answer, so its duration is an RTT sample.
+#if CONFIG_ESP_SVC_DISC_MEASURE_RTT
+        bool resolve = r->instance_name != NULL;
+#else
+        bool resolve = !r->hostname && r->instance_name;
+#endif
+        mdns_result_t *srv = NULL;
+        uint32_t rtt_ms = 0;
+        int64_t resolve_budget_ms = (resolve_deadline_us - esp_timer_get_time()) / 1000;
+        if (resolve && resolve_budget_ms <= 0) {
+            ESP_LOGD(TAG, "Resolve budget spent, not resolving %s", r->instance_name);
+            resolve = false;
+        }
+        if (resolve) {
+            uint32_t resolve_timeout_ms = resolve_budget_ms < CONFIG_ESP_SVC_DISC_RESOLVE_TIMEOUT_MS
+                                          ? (uint32_t)resolve_budget_ms : CONFIG_ESP_SVC_DISC_RESOLVE_TIMEOUT_MS;
+            if (svc_disc_query(r->instance_name, config->service_type, config->protocol, MDNS_TYPE_SRV,
+                               resolve_timeout_ms, 1, &srv, &rtt_ms) != ESP_OK) {
+                srv = NULL;
+                rtt_ms = 0;
+            }
+        }
+        
+        const char *hostname = (srv && srv->hostname) ? srv->hostname : r->hostname;
+        uint16_t port = (srv && srv->hostname) ? srv->port : r->port;
+        if (hostname && config->callback) {
+            ESP_LOGI(TAG, "Found service: %s at %s:%d", r->instance_name, hostname, port);
+            esp_svc_disc_table_update(r, config->service_type, config->protocol, hostname, port, rtt_ms);
+            config->callback(r->instance_name, hostname, port, r->txt, r->txt_count, config->user_data);
+        }
+        
+        if (srv) {
+            mdns_query_results_free(srv);
         }
         r = r->next;
     }
@@ -97,6 +431,8 @@ esp_err_t esp_svc_disc_deinit(void)
     
     mdns_free();
     
+    svc_table_clear();
+    
     if (s_discovery_event_group) {
         vEventGroupDelete(s_discovery_event_group);
         s_discovery_event_group = NULL;
@@ -131,18 +467,24 @@ esp_err_t esp_svc_disc_start(const esp_svc_disc_config_t* config)
     // Clear stop bit
     xEventGroupClearBits(s_discovery_event_group, DISCOVERY_STOP_BIT);
     
-    // Create discovery task
+    // Create discovery task. Mark it running first, a short browse may finish
+    // before xTaskCreate() returns.
+    s_discovery_running = true;
     BaseType_t ret = xTaskCreate(discovery_task, "svc_discovery", 4096, &s_current_config, 5, &s_discovery_task);
     if (ret != pdPASS) {
+        s_discovery_running = false;
         ESP_LOGE(TAG, "Failed to create discovery task");
         return ESP_ERR_NO_MEM;
     }
     
-    s_discovery_running = true;
-    
     return ESP_OK;
 }
 
+bool esp_svc_disc_is_running(void)
+{
+    return s_discovery_running;
+}
+
 esp_err_t esp_svc_disc_stop(void)
 {
     if (!s_discovery_running || !s_discovery_task) {
@@ -152,9 +494,15 @@ esp_err_t esp_svc_disc_stop(void)
     // Signal the task to stop
     xEventGroupSetBits(s_discovery_event_group, DISCOVERY_STOP_BIT);
     
+    // The task checks the stop bit between queries, so it exits once the
+    // browse or resolve in flight returns
+    uint32_t grace_ms = s_current_config.timeout_ms > CONFIG_ESP_SVC_DISC_RESOLVE_TIMEOUT_MS
+                        ? s_current_config.timeout_ms : CONFIG_ESP_SVC_DISC_RESOLVE_TIMEOUT_MS;
+    grace_ms += 1000;
+    
     // Wait for task to finish (with timeout)
-    int timeout_count = 0;
-    while (s_discovery_task != NULL && timeout_count < 50) {
+    uint32_t timeout_count = 0;
+    while (s_discovery_task != NULL && timeout_count < grace_ms / 100) {
         vTaskDelay(pdMS_TO_TICKS(100));
         timeout_count++;
     }
@@ -163,6 +511,7 @@ esp_err_t esp_svc_disc_stop(void)
         ESP_LOGW(TAG, "Discovery task did not stop gracefully, deleting forcefully");
         vTaskDelete(s_discovery_task);
         s_discovery_task = NULL;
+        svc_table_repair();
     }
     
     s_discovery_running = false;
@@ -172,6 +521,188 @@ esp_err_t esp_svc_disc_stop(void)
     return ESP_OK;
 }
 
+esp_err_t esp_svc_disc_get_services(const char* service_type,
+                                    const char* protocol,
+                                    esp_svc_disc_service_t* services,
+                                    size_t max_services,
+                                    size_t* count)
+{
+    if (!s_mdns_initialized) {
+        ESP_LOGE(TAG, "Service discovery not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    if (!services || !count) {
+        ESP_LOGE(TAG, "Invalid parameters");
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    uint32_t now_ms = svc_now_ms();
+    *count = 0;
+    for (size_t i = 0; i < CONFIG_ESP_SVC_DISC_MAX_SERVICES && *count < max_services; i++) {
+        esp_svc_disc_service_t *out = &services[*count];
+        if (svc_table_read_slot(&s_service_table[i], out) &&
+            svc_table_matches(out, NULL, service_type, protocol) &&
+            svc_table_fresh(out->last_seen_ms, now_ms)) {
+            (*count)++;
+        }
+    }
+    
+    return ESP_OK;
+}
+
+esp_err_t esp_svc_disc_find_service(const char* instance_name,
+                                    const char* service_type,
+                                    const char* protocol,
+                                    esp_svc_disc_service_t* service)
+{
+    if (!s_mdns_initialized) {
+        ESP_LOGE(TAG, "Service discovery not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    if (!instance_name || !service_type || !protocol || !service) {
+        ESP_LOGE(TAG, "Invalid parameters");
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    uint32_t now_ms = svc_now_ms();
+    for (size_t i = 0; i < CONFIG_ESP_SVC_DISC_MAX_SERVICES; i++) {
+        if (svc_table_read_slot(&s_service_table[i], service) &&
+            svc_table_matches(service, instance_name, service_type, protocol) &&
+            svc_table_fresh(service->last_seen_ms, now_ms)) {
+            return ESP_OK;
+        }
+    }
+    
+    return ESP_ERR_NOT_FOUND;
+}
+
+static void endpoint_candidate(const esp_svc_disc_service_t *service, esp_svc_disc_endpoint_candidate_t *c)
+{
+    *c = (esp_svc_disc_endpoint_candidate_t) {
+        .valid = true,
+        .priority = service->priority,
+        .weight = service->weight,
+        .load = service->load,
+        .rtt_ms = service->rtt_ms,
+        .last_seen_ms = service->last_seen_ms,
+    };
+}
+
+static bool endpoint_usable(const esp_svc_disc_endpoint_candidate_t *c, uint32_t now_ms)
+{
+    if (!c->valid || c->load >= ENDPOINT_MAX_LOAD) {
+        return false;
+    }
+    return svc_table_fresh(c->last_seen_ms, now_ms);
+}
+
+// SRV-style weight scaled by spare capacity and by RTT_REF_MS / (rtt + RTT_REF_MS)
+static uint32_t endpoint_weight(const esp_svc_disc_endpoint_candidate_t *c, uint32_t rtt_default_ms)
+{
+    uint32_t base = (uint32_t)(c->weight ? c->weight : 1) * (ENDPOINT_MAX_LOAD - c->load);
+    uint32_t rtt_ms = c->rtt_ms ? c->rtt_ms : rtt_default_ms;
+    uint32_t weight = (uint32_t)(((uint64_t)base * ENDPOINT_RTT_REF_MS * 100) / (rtt_ms + ENDPOINT_RTT_REF_MS));
+    return weight ? weight : 1;
+}
+
+int esp_svc_disc_select_endpoint(const esp_svc_disc_endpoint_candidate_t *candidates, size_t count,
+                                 uint32_t now_ms, uint64_t random)
+{
+    uint16_t min_priority = UINT16_MAX;
+    bool found = false;
+    
+    for (size_t i = 0; i < count; i++) {
+        if (endpoint_usable(&candidates[i], now_ms)) {
+            if (candidates[i].priority < min_priority) {
+                min_priority = candidates[i].priority;
+            }
+            found = true;
+        }
+    }
+    if (!found) {
+        return -1;
+    }
+    
+    // Instances without an RTT sample are assumed to be average
+    uint32_t rtt_sum = 0;
+    uint32_t rtt_known = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (endpoint_usable(&candidates[i], now_ms) && candidates[i].priority == min_priority && candidates[i].rtt_ms) {
+            rtt_sum += candidates[i].rtt_ms;
+            rtt_known++;
+        }
+    }
+    uint32_t rtt_default_ms = rtt_known ? rtt_sum / rtt_known : 0;
+    
+    uint64_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (endpoint_usable(&candidates[i], now_ms) && candidates[i].priority == min_priority) {
+            total += endpoint_weight(&candidates[i], rtt_default_ms);
+        }
+    }
+    
+    uint64_t pick = random % total;
+    for (size_t i = 0; i < count; i++) {
+        if (!endpoint_usable(&candidates[i], now_ms) || candidates[i].priority != min_priority) {
+            continue;
+        }
+        uint32_t weight = endpoint_weight(&candidates[i], rtt_default_ms);
+        if (pick < weight) {
+            return (int)i;
+        }
+        pick -= weight;
+    }
+    return -1;
+}
+
+esp_err_t esp_svc_disc_pick_endpoint(const char* service_type,
+                                     const char* protocol,
+                                     esp_svc_disc_service_t* endpoint)
+{
+    if (!s_mdns_initialized) {
+        ESP_LOGE(TAG, "Service discovery not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    if (!service_type || !protocol || !endpoint) {
+        ESP_LOGE(TAG, "Invalid parameters");
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    // Readers don't lock, so the chosen slot may change before it is re-read; retry then
+    for (int attempt = 0; attempt < ENDPOINT_PICK_RETRIES; attempt++) {
+        esp_svc_disc_endpoint_candidate_t candidates[CONFIG_ESP_SVC_DISC_MAX_SERVICES] = {0};
+        
+        for (size_t i = 0; i < CONFIG_ESP_SVC_DISC_MAX_SERVICES; i++) {
+            if (svc_table_read_slot(&s_service_table[i], endpoint) &&
+                svc_table_matches(endpoint, NULL, service_type, protocol)) {
+                endpoint_candidate(endpoint, &candidates[i]);
+            }
+        }
+        
+        uint32_t now_ms = svc_now_ms();
+        uint64_t random = ((uint64_t)esp_random() << 32) | esp_random();
+        int chosen = esp_svc_disc_select_endpoint(candidates, CONFIG_ESP_SVC_DISC_MAX_SERVICES, now_ms, random);
+        if (chosen < 0) {
+            return ESP_ERR_NOT_FOUND;
+        }
+        
+        esp_svc_disc_endpoint_candidate_t reread = {0};
+        if (svc_table_read_slot(&s_service_table[chosen], endpoint) &&
+            svc_table_matches(endpoint, NULL, service_type, protocol)) {
+            endpoint_candidate(endpoint, &reread);
+        }
+        if (endpoint_usable(&reread, now_ms)) {
+            ESP_LOGD(TAG, "Picked endpoint %s at %s:%d", endpoint->instance_name, endpoint->hostname, endpoint->port);
+            return ESP_OK;
+        }
+    }
+    
+    return ESP_ERR_NOT_FOUND;
+}
+
 esp_err_t esp_svc_disc_set_hostname(const char* hostname)
 {
     if (!s_mdns_initialized) {
@@ -212,7 +743,30 @@ esp_err_t esp_svc_disc_advertise_service(const char* instance_name,
         return ESP_ERR_INVALID_ARG;
     }
     
-    esp_err_t err = mdns_service_add(instance_name, service_type, protocol, port, txt_records, txt_count);
+    esp_err_t err;
+    if (mdns_service_exists_with_instance(instance_name, service_type, protocol, NULL)) {
+        // Already registered: update the records in place instead of failing on a duplicate add
+        err = mdns_service_port_set_for_host(instance_name, service_type, protocol, NULL, port);
+        if (err == ESP_OK) {
+            err = mdns_service_txt_set_for_host(instance_name, service_type, protocol, NULL,
+                                                txt_records, (uint8_t)txt_count);
+        }
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to update service: %s", esp_err_to_name(err));
+            return err;
+        }
+        
+        ESP_LOGI(TAG, "Service updated: %s.%s.%s on port %d", instance_name, service_type, protocol, port);
+        
+        return ESP_OK;
+    }
+    
+#if CONFIG_ESP_SVC_DISC_REGISTER_DELAY_MAX_MS > 0
+    // Spread the first announcements of devices that power up together
+    vTaskDelay(pdMS_TO_TICKS(esp_random() % (CONFIG_ESP_SVC_DISC_REGISTER_DELAY_MAX_MS + 1)));
+#endif
+    
+    err = mdns_service_add(instance_name, service_type, protocol, port, txt_records, txt_count);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to add service: %s", esp_err_to_name(err));
         return err;
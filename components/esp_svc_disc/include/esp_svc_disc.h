@@ -1,7 +1,9 @@
 #pragma once
 
+#include <stdbool.h>
 #include "esp_err.h"
 #include "mdns.h"
+#include "sdkconfig.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -24,6 +26,26 @@ typedef void (*esp_svc_disc_callback_t)(const char* service_name,
                                         size_t txt_count,
                                         void* user_data);
 
+#define ESP_SVC_DISC_SERVICE_TYPE_LEN 17   ///< Service type (RFC 6335: 15 chars) incl. leading '_' and terminator
+#define ESP_SVC_DISC_PROTOCOL_LEN     8    ///< Protocol ("_tcp"/"_udp") incl. terminator
+#define ESP_SVC_DISC_HOSTNAME_LEN     CONFIG_ESP_SVC_DISC_MAX_HOSTNAME_LEN ///< Hostname incl. terminator
+
+/**
+ * @brief Snapshot of one entry of the discovered-service table
+ */
+typedef struct {
+    char instance_name[CONFIG_ESP_SVC_DISC_MAX_SERVICE_NAME_LEN]; ///< Instance name
+    char service_type[ESP_SVC_DISC_SERVICE_TYPE_LEN];             ///< Service type (e.g., "_http")
+    char protocol[ESP_SVC_DISC_PROTOCOL_LEN];                     ///< Protocol ("_tcp" or "_udp")
+    char hostname[ESP_SVC_DISC_HOSTNAME_LEN];                     ///< Hostname of the service
+    uint16_t port;                                                ///< Port number of the service
+    uint16_t priority;                                            ///< Priority from TXT "priority" (lower is preferred)
+    uint16_t weight;                                              ///< Weight from TXT "weight" within a priority
+    uint8_t load;                                                 ///< Load hint 0-100 from TXT "load"
+    uint32_t rtt_ms;                                              ///< Rolling RTT estimate, 0 if not yet measured
+    uint32_t last_seen_ms;                                        ///< Time of last answer (ms since boot)
+} esp_svc_disc_service_t;
+
 /**
  * @brief Configuration structure for service discovery
  */
@@ -60,10 +82,82 @@ esp_err_t esp_svc_disc_start(const esp_svc_disc_config_t* config);
 /**
  * @brief Stop ongoing service discovery
  * 
+ * Blocks until the browse or resolve query in flight has returned.
+ * 
  * @return ESP_OK on success, error code otherwise
  */
 esp_err_t esp_svc_disc_stop(void);
 
+/**
+ * @brief Check whether a discovery started with esp_svc_disc_start() is still running
+ * 
+ * Becomes false once the browse and its resolves have completed and every
+ * callback has returned, or after esp_svc_disc_stop().
+ * 
+ * @return true while discovery is running
+ */
+bool esp_svc_disc_is_running(void);
+
+/**
+ * @brief Copy out the discovered services matching a type
+ *
+ * Lock-free: the table is published with a per-entry sequence lock, so any
+ * number of tasks on either core can call this concurrently with each other
+ * and with the discovery task without taking a mutex. Entries not seen by a
+ * browse within CONFIG_ESP_SVC_DISC_SERVICE_MAX_AGE_MS are skipped.
+ *
+ * @param service_type Service type to match, or NULL for all
+ * @param protocol Protocol to match, or NULL for all
+ * @param services Output array
+ * @param max_services Capacity of the output array
+ * @param count Number of entries written to services
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t esp_svc_disc_get_services(const char* service_type,
+                                    const char* protocol,
+                                    esp_svc_disc_service_t* services,
+                                    size_t max_services,
+                                    size_t* count);
+
+/**
+ * @brief Look up a single discovered service instance
+ *
+ * Lock-free and subject to the same max age, see esp_svc_disc_get_services().
+ *
+ * @param instance_name Instance name of the service
+ * @param service_type Service type
+ * @param protocol Protocol
+ * @param service Output snapshot of the entry
+ * @return ESP_OK if found, ESP_ERR_NOT_FOUND if not cached, error code otherwise
+ */
+esp_err_t esp_svc_disc_find_service(const char* instance_name,
+                                    const char* service_type,
+                                    const char* protocol,
+                                    esp_svc_disc_service_t* service);
+
+/**
+ * @brief Pick one endpoint among the cached instances of a service type
+ *
+ * Candidates with the lowest priority are chosen between at random,
+ * proportionally to their weight, scaled down by their load hint and by
+ * their rolling RTT estimate. Instances reporting a load of 100 or not seen
+ * within CONFIG_ESP_SVC_DISC_SERVICE_MAX_AGE_MS are skipped.
+ *
+ * RTT is only sampled by explicit SRV resolves. Browse answers usually carry
+ * the SRV record already, so with CONFIG_ESP_SVC_DISC_MEASURE_RTT disabled
+ * (the default) most instances have no RTT estimate and the choice depends
+ * on priority, weight and load only.
+ * Lock-free, see esp_svc_disc_get_services().
+ *
+ * @param service_type Service type (e.g., "_http")
+ * @param protocol Protocol ("_tcp" or "_udp")
+ * @param endpoint Output snapshot of the chosen entry
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if no usable instance is cached
+ */
+esp_err_t esp_svc_disc_pick_endpoint(const char* service_type,
+                                     const char* protocol,
+                                     esp_svc_disc_service_t* endpoint);
+
 /**
  * @brief Set the hostname for this device (for mDNS advertising)
  * 
@@ -75,6 +169,11 @@ esp_err_t esp_svc_disc_set_hostname(const char* hostname);
 /**
  * @brief Advertise a service on the local network
  * 
+ * Advertising an instance that is already registered updates its port and
+ * TXT records in place. A new instance is registered after a random delay of
+ * up to CONFIG_ESP_SVC_DISC_REGISTER_DELAY_MAX_MS, during which the call
+ * blocks.
+ * 
  * @param instance_name Instance name of the service
  * @param service_type Service type (e.g., "_http")
  * @param protocol Protocol ("_tcp" or "_udp")
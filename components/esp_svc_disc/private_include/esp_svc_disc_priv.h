@@ -0,0 +1,59 @@
+#pragma once
+
+#include "esp_svc_disc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Internal interfaces, exposed for the unit tests only.
+ */
+
+/**
+ * @brief Insert or refresh an entry of the discovered-service table
+ *
+ * Must only be called from the single table writer (the discovery task, or
+ * a test with discovery stopped).
+ *
+ * @param r mDNS result supplying the instance name and TXT records
+ * @param service_type Service type
+ * @param protocol Protocol
+ * @param hostname Resolved hostname
+ * @param port Resolved port
+ * @param rtt_sample_ms RTT sample for this answer, 0 if not measured
+ */
+void esp_svc_disc_table_update(const mdns_result_t *r, const char *service_type, const char *protocol,
+                               const char *hostname, uint16_t port, uint32_t rtt_sample_ms);
+
+/**
+ * @brief Endpoint selection input, one per table slot
+ */
+typedef struct {
+    bool valid;                 ///< Slot holds an instance of the requested type
+    uint16_t priority;          ///< Lower is preferred
+    uint16_t weight;            ///< Relative share within a priority (0 counts as 1)
+    uint8_t load;               ///< Load hint 0-100; 100 is never picked
+    uint32_t rtt_ms;            ///< Rolling RTT estimate, 0 if unknown
+    uint32_t last_seen_ms;      ///< Time of last answer (ms since boot)
+} esp_svc_disc_endpoint_candidate_t;
+
+/**
+ * @brief Choose among endpoint candidates
+ *
+ * Skips invalid, fully loaded and stale (CONFIG_ESP_SVC_DISC_SERVICE_MAX_AGE_MS)
+ * candidates, keeps the lowest priority and maps random onto the remaining
+ * candidates in proportion to weight x spare load x RTT factor.
+ *
+ * @param candidates Candidate array
+ * @param count Number of candidates
+ * @param now_ms Current time (ms since boot)
+ * @param random Random value selecting the candidate
+ * @return Index of the chosen candidate, -1 if none is usable
+ */
+int esp_svc_disc_select_endpoint(const esp_svc_disc_endpoint_candidate_t *candidates, size_t count,
+                                 uint32_t now_ms, uint64_t random);
+
+#ifdef __cplusplus
+}
+#endif
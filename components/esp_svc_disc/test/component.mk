@@ -0,0 +1,7 @@
+#
+# Component Makefile for the ESP Service Discovery unit tests
+#
+
+COMPONENT_PRIV_INCLUDEDIRS := ../private_include
+
+COMPONENT_ADD_LDFLAGS = -Wl,--whole-archive -l$(COMPONENT_NAME) -Wl,--no-whole-archive
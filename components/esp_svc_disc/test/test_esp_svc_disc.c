@@ -1,6 +1,12 @@
+#include <stdio.h>
+#include <string.h>
 #include "unity.h"
 #include "esp_svc_disc.h"
+#include "esp_svc_disc_priv.h"
 #include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
 
 static const char *TAG = "ESP_SVC_DISC_TEST";
 
@@ -91,6 +97,36 @@ TEST_CASE("esp_svc_disc_config_validation", "[esp_svc_disc]")
     esp_svc_disc_deinit();
 }
 
+// Port mDNS holds for one of our instances, 0 if it has none
+static uint16_t advertised_port(const char* instance_name, const char* service_type, const char* protocol)
+{
+    mdns_result_t *result = NULL;
+    uint16_t port = 0;
+    if (mdns_lookup_selfhosted_service(instance_name, service_type, protocol, 1, &result) == ESP_OK && result) {
+        port = result->port;
+    }
+    mdns_query_results_free(result);
+    return port;
+}
+
+// TXT value mDNS holds for one of our instances, "" if it has none
+static const char* advertised_txt(const char* instance_name, const char* service_type,
+                                  const char* protocol, const char* key)
+{
+    static char value[32];
+    mdns_result_t *result = NULL;
+    value[0] = '\0';
+    if (mdns_lookup_selfhosted_service(instance_name, service_type, protocol, 1, &result) == ESP_OK && result) {
+        for (size_t i = 0; i < result->txt_count; i++) {
+            if (strcmp(result->txt[i].key, key) == 0 && result->txt[i].value) {
+                strlcpy(value, result->txt[i].value, sizeof(value));
+            }
+        }
+    }
+    mdns_query_results_free(result);
+    return value;
+}
+
 TEST_CASE("esp_svc_disc_service_advertisement", "[esp_svc_disc]")
 {
     // Initialize first
@@ -107,6 +143,22 @@ TEST_CASE("esp_svc_disc_service_advertisement", "[esp_svc_disc]")
                                         txt_records, 2);
     TEST_ASSERT_EQUAL(ESP_OK, ret);
     
+    // Advertising the instance again updates its records in place
+    txt_records[0].value = "1.1";
+    ret = esp_svc_disc_advertise_service("Test Service", "_http", "_tcp", 8081, 
+                                        txt_records, 2);
+    TEST_ASSERT_EQUAL(ESP_OK, ret);
+    TEST_ASSERT_EQUAL(8081, advertised_port("Test Service", "_http", "_tcp"));
+    TEST_ASSERT_EQUAL_STRING("1.1", advertised_txt("Test Service", "_http", "_tcp", "version"));
+    
+    // A second instance of the same type is added alongside the first
+    ret = esp_svc_disc_advertise_service("Other Service", "_http", "_tcp", 8090, NULL, 0);
+    TEST_ASSERT_EQUAL(ESP_OK, ret);
+    TEST_ASSERT_TRUE(mdns_service_exists_with_instance("Test Service", "_http", "_tcp", NULL));
+    TEST_ASSERT_TRUE(mdns_service_exists_with_instance("Other Service", "_http", "_tcp", NULL));
+    TEST_ASSERT_EQUAL(8081, advertised_port("Test Service", "_http", "_tcp"));
+    TEST_ASSERT_EQUAL(8090, advertised_port("Other Service", "_http", "_tcp"));
+    
     // Test removing the service
     ret = esp_svc_disc_remove_service("_http", "_tcp");
     TEST_ASSERT_EQUAL(ESP_OK, ret);
@@ -125,6 +177,251 @@ TEST_CASE("esp_svc_disc_service_advertisement", "[esp_svc_disc]")
     esp_svc_disc_deinit();
 }
 
+TEST_CASE("esp_svc_disc_service_table", "[esp_svc_disc]")
+{
+    // Initialize first
+    esp_err_t ret = esp_svc_disc_init();
+    TEST_ASSERT_EQUAL(ESP_OK, ret);
+    
+    // Table starts out empty
+    esp_svc_disc_service_t services[4];
+    size_t count = 1;
+    ret = esp_svc_disc_get_services(NULL, NULL, services, 4, &count);
+    TEST_ASSERT_EQUAL(ESP_OK, ret);
+    TEST_ASSERT_EQUAL(0, count);
+    
+    esp_svc_disc_service_t service;
+    ret = esp_svc_disc_find_service("Test", "_http", "_tcp", &service);
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, ret);
+    
+    // Test with invalid parameters
+    ret = esp_svc_disc_get_services("_http", "_tcp", NULL, 4, &count);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, ret);
+    
+    ret = esp_svc_disc_get_services("_http", "_tcp", services, 4, NULL);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, ret);
+    
+    ret = esp_svc_disc_find_service(NULL, "_http", "_tcp", &service);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, ret);
+    
+    ret = esp_svc_disc_find_service("Test", "_http", "_tcp", NULL);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, ret);
+    
+    // No endpoint to pick from an empty table
+    ret = esp_svc_disc_pick_endpoint("_http", "_tcp", &service);
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, ret);
+    
+    ret = esp_svc_disc_pick_endpoint(NULL, "_tcp", &service);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, ret);
+    
+    ret = esp_svc_disc_pick_endpoint("_http", "_tcp", NULL);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, ret);
+    
+    // Cleanup
+    esp_svc_disc_deinit();
+}
+
+// Write a table entry as the discovery task would
+static void table_put(const char* instance, const char* service_type, const char* hostname, uint16_t port)
+{
+    mdns_result_t r = { .instance_name = (char *)instance };
+    esp_svc_disc_table_update(&r, service_type, "_tcp", hostname, port, 0);
+}
+
+TEST_CASE("esp_svc_disc_service_table_lookup_and_replacement", "[esp_svc_disc]")
+{
+    esp_err_t ret = esp_svc_disc_init();
+    TEST_ASSERT_EQUAL(ESP_OK, ret);
+    
+    // Fill the table, one tick apart so the replacement order is deterministic
+    char name[16];
+    for (int i = 0; i < CONFIG_ESP_SVC_DISC_MAX_SERVICES; i++) {
+        snprintf(name, sizeof(name), "svc-%d", i);
+        table_put(name, "_http", "host", 8000 + i);
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    
+    esp_svc_disc_service_t service;
+    ret = esp_svc_disc_find_service("svc-3", "_http", "_tcp", &service);
+    TEST_ASSERT_EQUAL(ESP_OK, ret);
+    TEST_ASSERT_EQUAL(8003, service.port);
+    TEST_ASSERT_EQUAL_STRING("host", service.hostname);
+    
+    esp_svc_disc_service_t services[CONFIG_ESP_SVC_DISC_MAX_SERVICES];
+    size_t count = 0;
+    ret = esp_svc_disc_get_services("_http", "_tcp", services, CONFIG_ESP_SVC_DISC_MAX_SERVICES, &count);
+    TEST_ASSERT_EQUAL(ESP_OK, ret);
+    TEST_ASSERT_EQUAL(CONFIG_ESP_SVC_DISC_MAX_SERVICES, count);
+    
+    // Refreshing an entry updates it in place and makes svc-1 the least recently seen
+    table_put("svc-0", "_http", "host", 9000);
+    vTaskDelay(pdMS_TO_TICKS(10));
+    table_put("svc-new", "_http", "host", 9001);
+    
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, esp_svc_disc_find_service("svc-1", "_http", "_tcp", &service));
+    TEST_ASSERT_EQUAL(ESP_OK, esp_svc_disc_find_service("svc-0", "_http", "_tcp", &service));
+    TEST_ASSERT_EQUAL(9000, service.port);
+    TEST_ASSERT_EQUAL(ESP_OK, esp_svc_disc_find_service("svc-new", "_http", "_tcp", &service));
+    
+    // Longest RFC 6335 service type is stored and matched in full
+    table_put("svc-long", "_abcdefghijklmno", "host", 9002);
+    TEST_ASSERT_EQUAL(ESP_OK, esp_svc_disc_find_service("svc-long", "_abcdefghijklmno", "_tcp", &service));
+    TEST_ASSERT_EQUAL_STRING("_abcdefghijklmno", service.service_type);
+    
+    // Names that do not fit are not cached rather than truncated
+    char hostname[ESP_SVC_DISC_HOSTNAME_LEN + 1];
+    memset(hostname, 'h', sizeof(hostname) - 1);
+    hostname[sizeof(hostname) - 1] = '\0';
+    table_put("svc-bad", "_http", hostname, 9003);
+    TEST_ASSERT_EQUAL(ESP_ERR_NOT_FOUND, esp_svc_disc_find_service("svc-bad", "_http", "_tcp", &service));
+    
+    // Cleanup
+    esp_svc_disc_deinit();
+}
+
+typedef struct {
+    volatile bool stop;
+    int reads;
+    int torn;
+    SemaphoreHandle_t done;
+} table_reader_t;
+
+static void table_reader_task(void *pvParameters)
+{
+    table_reader_t *reader = (table_reader_t *)pvParameters;
+    esp_svc_disc_service_t service;
+    char expected[ESP_SVC_DISC_HOSTNAME_LEN];
+    
+    while (!reader->stop) {
+        if (esp_svc_disc_find_service("svc-rw", "_http", "_tcp", &service) == ESP_OK) {
+            // The writer always pairs host-<port> with <port>
+            snprintf(expected, sizeof(expected), "host-%u", service.port);
+            if (strcmp(expected, service.hostname) != 0) {
+                reader->torn++;
+            }
+            reader->reads++;
+        }
+    }
+    
+    xSemaphoreGive(reader->done);
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("esp_svc_disc_service_table_concurrent_reads", "[esp_svc_disc]")
+{
+    esp_err_t ret = esp_svc_disc_init();
+    TEST_ASSERT_EQUAL(ESP_OK, ret);
+    
+    table_put("svc-rw", "_http", "host-0", 0);
+    
+    // One reader per core, racing the writer below
+    table_reader_t readers[2] = {0};
+    for (int i = 0; i < 2; i++) {
+        readers[i].done = xSemaphoreCreateBinary();
+        TEST_ASSERT_NOT_NULL(readers[i].done);
+        xTaskCreatePinnedToCore(table_reader_task, "table_reader", 3072, &readers[i], 5, NULL,
+                                i % portNUM_PROCESSORS);
+    }
+    
+    char hostname[ESP_SVC_DISC_HOSTNAME_LEN];
+    for (uint16_t port = 1; port <= 5000; port++) {
+        snprintf(hostname, sizeof(hostname), "host-%u", port);
+        table_put("svc-rw", "_http", hostname, port);
+        if (port % 500 == 0) {
+            vTaskDelay(1);
+        }
+    }
+    
+    for (int i = 0; i < 2; i++) {
+        readers[i].stop = true;
+        xSemaphoreTake(readers[i].done, portMAX_DELAY);
+        vSemaphoreDelete(readers[i].done);
+        TEST_ASSERT_EQUAL(0, readers[i].torn);
+        TEST_ASSERT_TRUE(readers[i].reads > 0);
+    }
+    
+    // Cleanup
+    esp_svc_disc_deinit();
+}
+
+// Map every value of [0, draws) through the selection and count the picks
+static void count_picks(const esp_svc_disc_endpoint_candidate_t* candidates, size_t count,
+                        uint32_t draws, uint32_t* hits)
+{
+    for (uint32_t r = 0; r < draws; r++) {
+        int chosen = esp_svc_disc_select_endpoint(candidates, count, 1000, r);
+        TEST_ASSERT_TRUE(chosen >= 0 && chosen < (int)count);
+        hits[chosen]++;
+    }
+}
+
+TEST_CASE("esp_svc_disc_select_endpoint", "[esp_svc_disc]")
+{
+    // Lowest priority wins regardless of weight
+    esp_svc_disc_endpoint_candidate_t by_priority[] = {
+        { .valid = true, .priority = 1, .weight = 100, .last_seen_ms = 1000 },
+        { .valid = true, .priority = 0, .weight = 1, .last_seen_ms = 1000 },
+    };
+    TEST_ASSERT_EQUAL(1, esp_svc_disc_select_endpoint(by_priority, 2, 1000, 0));
+    TEST_ASSERT_EQUAL(1, esp_svc_disc_select_endpoint(by_priority, 2, 1000, UINT64_MAX));
+    
+    // Fully loaded, invalid and stale candidates are never picked
+    esp_svc_disc_endpoint_candidate_t unusable[] = {
+        { .valid = true, .load = 100, .last_seen_ms = 1000 },
+        { .valid = false, .last_seen_ms = 1000 },
+    };
+    TEST_ASSERT_EQUAL(-1, esp_svc_disc_select_endpoint(unusable, 2, 1000, 0));
+#if CONFIG_ESP_SVC_DISC_SERVICE_MAX_AGE_MS > 0
+    esp_svc_disc_endpoint_candidate_t stale[] = {
+        { .valid = true, .priority = 0, .last_seen_ms = 0 },
+        { .valid = true, .priority = 1, .last_seen_ms = CONFIG_ESP_SVC_DISC_SERVICE_MAX_AGE_MS + 1 },
+    };
+    TEST_ASSERT_EQUAL(1, esp_svc_disc_select_endpoint(stale, 2, CONFIG_ESP_SVC_DISC_SERVICE_MAX_AGE_MS + 1, 0));
+#endif
+    
+    // Weight 1:3 at equal RTT and load splits 1:3
+    uint32_t hits[3] = {0};
+    esp_svc_disc_endpoint_candidate_t by_weight[] = {
+        { .valid = true, .weight = 1, .rtt_ms = 10, .last_seen_ms = 1000 },
+        { .valid = true, .weight = 3, .rtt_ms = 10, .last_seen_ms = 1000 },
+    };
+    count_picks(by_weight, 2, 20000, hits);
+    TEST_ASSERT_EQUAL(5000, hits[0]);
+    TEST_ASSERT_EQUAL(15000, hits[1]);
+    
+    // Load 50 halves the share
+    memset(hits, 0, sizeof(hits));
+    esp_svc_disc_endpoint_candidate_t by_load[] = {
+        { .valid = true, .weight = 1, .load = 50, .last_seen_ms = 1000 },
+        { .valid = true, .weight = 1, .load = 0, .last_seen_ms = 1000 },
+    };
+    count_picks(by_load, 2, 30000, hits);
+    TEST_ASSERT_EQUAL(10000, hits[0]);
+    TEST_ASSERT_EQUAL(20000, hits[1]);
+    
+    // 10 ms vs 30 ms RTT splits 2:1
+    memset(hits, 0, sizeof(hits));
+    esp_svc_disc_endpoint_candidate_t by_rtt[] = {
+        { .valid = true, .weight = 1, .rtt_ms = 10, .last_seen_ms = 1000 },
+        { .valid = true, .weight = 1, .rtt_ms = 30, .last_seen_ms = 1000 },
+    };
+    count_picks(by_rtt, 2, 30000, hits);
+    TEST_ASSERT_EQUAL(20000, hits[0]);
+    TEST_ASSERT_EQUAL(10000, hits[1]);
+    
+    // An unmeasured instance counts as the average RTT (20 ms)
+    memset(hits, 0, sizeof(hits));
+    esp_svc_disc_endpoint_candidate_t unmeasured[] = {
+        { .valid = true, .weight = 1, .rtt_ms = 10, .last_seen_ms = 1000 },
+        { .valid = true, .weight = 1, .rtt_ms = 30, .last_seen_ms = 1000 },
+        { .valid = true, .weight = 1, .rtt_ms = 0, .last_seen_ms = 1000 },
+    };
+    count_picks(unmeasured, 3, 5000 + 2500 + 3333, hits);
+    TEST_ASSERT_EQUAL(5000, hits[0]);
+    TEST_ASSERT_EQUAL(2500, hits[1]);
+    TEST_ASSERT_EQUAL(3333, hits[2]);
+}
+
 TEST_CASE("esp_svc_disc_without_init", "[esp_svc_disc]")
 {
     // Test functions without initialization (should fail)
@@ -146,4 +443,9 @@ TEST_CASE("esp_svc_disc_without_init", "[esp_svc_disc]")
     
     ret = esp_svc_disc_remove_service("_http", "_tcp");
     TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, ret);
+    
+    esp_svc_disc_service_t services[1];
+    size_t count = 0;
+    ret = esp_svc_disc_get_services(NULL, NULL, services, 1, &count);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, ret);
 }
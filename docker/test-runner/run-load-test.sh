@@ -0,0 +1,47 @@
+#!/bin/bash
+
+# ESP Service Discovery Load Test
+# ===============================
+# Floods a tap interface with synthetic mDNS instances and runs the QEMU
+# firmware built from example/sdkconfig.loadtest against them.
+# Needs root for the tap interface, DHCP and tc netem.
+# Extra arguments are passed to test-runner.py --load.
+
+set -e
+
+SCRIPT_DIR="$(cd "$(dirname "$0")" && pwd)"
+INTERFACE="${LOAD_INTERFACE:-tap0}"
+TAP_ADDR="${LOAD_TAP_ADDR:-172.21.0.1/24}"
+DHCP_RANGE="${LOAD_DHCP_RANGE:-172.21.0.10,172.21.0.50}"
+
+echo "🧪 Running ESP Service Discovery Load Test"
+echo "=========================================="
+
+for tool in ip dnsmasq tc qemu-system-xtensa; do
+    if ! command -v "$tool" &> /dev/null; then
+        echo "❌ $tool not found"
+        exit 1
+    fi
+done
+
+if ! python3 -c "import zeroconf, requests" &> /dev/null; then
+    echo "❌ python3 needs the zeroconf and requests packages (sudo pip3 install zeroconf requests)"
+    exit 1
+fi
+
+# Tap interface the QEMU open_eth NIC attaches to
+if ! ip link show "$INTERFACE" &> /dev/null; then
+    echo "🔌 Creating $INTERFACE ($TAP_ADDR)..."
+    ip tuntap add dev "$INTERFACE" mode tap
+    ip addr add "$TAP_ADDR" dev "$INTERFACE"
+fi
+ip link set dev "$INTERFACE" up
+
+# The firmware uses DHCP
+echo "📡 Starting DHCP on $INTERFACE..."
+dnsmasq --keep-in-foreground --port=0 --bind-interfaces --interface="$INTERFACE" \
+    --except-interface=lo --dhcp-range="$DHCP_RANGE,1h" --pid-file= &
+DNSMASQ_PID=$!
+trap 'kill $DNSMASQ_PID 2>/dev/null || true' EXIT
+
+python3 "$SCRIPT_DIR/test-runner.py" --load --interface "$INTERFACE" "$@"
@@ -1,11 +1,18 @@
 #!/usr/bin/env python3
 
+import argparse
 import asyncio
+import json
+import random
+import re
+import shlex
 import socket
+import string
 import time
 import subprocess
 import sys
-from zeroconf import ServiceBrowser, ServiceListener, Zeroconf
+from zeroconf import ServiceBrowser, ServiceInfo, ServiceListener, Zeroconf
+from zeroconf.asyncio import AsyncZeroconf
 import threading
 import requests
 
@@ -242,6 +249,316 @@ def test_avahi_browse():
     
     print()
 
+# === Load mode ===
+#
+# Registers hundreds to thousands of synthetic instances with python-zeroconf,
+# runs the firmware built from example/sdkconfig.loadtest against them and
+# derives discovery completeness, latency and device heap/CPU from its console.
+
+DEFAULT_DEVICE_CMD = (
+    "qemu-system-xtensa -M esp32 -m 4M -nographic "
+    "-drive file=example/build-loadtest/qemu/flash_image.bin,if=mtd,format=raw "
+    "-nic tap,model=open_eth,ifname={interface},script=no,downscript=no"
+)
+
+ANSI_RE = re.compile(r'\x1b\[[0-9;]*m')
+LOG_RE = re.compile(r'^[EWIDV] \((\d+)\) ([^:]+): (.*)$')
+FOUND_RE = re.compile(r'^Found service: (.*) at (\S+):(\d+)$')
+STATS_RE = re.compile(r'^STATS heap_free=(\d+) heap_min=(\d+) cpu0_load=(\d+)$')
+CRASH_MARKERS = ("Guru Meditation", "abort() was called", "Backtrace:")
+TXT_ITEM_MAX = 200
+
+
+def interface_ipv4(interface):
+    """Return the first IPv4 address configured on a network interface"""
+    result = subprocess.run(['ip', '-4', '-o', 'addr', 'show', 'dev', interface],
+                            capture_output=True, text=True, check=True)
+    match = re.search(r'inet (\d+\.\d+\.\d+\.\d+)', result.stdout)
+    if not match:
+        raise RuntimeError(f"No IPv4 address on {interface}")
+    return match.group(1)
+
+
+class PacketLoss:
+    """Drop a percentage of packets sent towards the device with tc netem"""
+
+    def __init__(self, interface, loss_pct):
+        self.interface = interface
+        self.loss_pct = loss_pct
+
+    def __enter__(self):
+        if self.loss_pct > 0:
+            subprocess.run(['tc', 'qdisc', 'replace', 'dev', self.interface, 'root',
+                            'netem', 'loss', f'{self.loss_pct}%'], check=True)
+            print(f"Packet loss on {self.interface}: {self.loss_pct}%")
+        return self
+
+    def __exit__(self, *exc):
+        if self.loss_pct > 0:
+            subprocess.run(['tc', 'qdisc', 'del', 'dev', self.interface, 'root'], check=False)
+
+
+class SyntheticServiceFleet:
+    """Synthetic mDNS instances with varied TXT sizes and optional churn"""
+
+    def __init__(self, address, args):
+        self.address = address
+        self.args = args
+        self.rng = random.Random(args.seed)
+        self.type_ = f"{args.service_type}.local."
+        self.infos = [self._make_info(i) for i in range(args.instances)]
+        churn_count = int(args.instances * args.churn_fraction) if args.churn_rate > 0 else 0
+        # Churning instances are the last ones; completeness is measured over the stable rest
+        self.stable = {info.name[:-len(self.type_) - 1] for info in self.infos[:args.instances - churn_count]}
+        self.churn_pool = self.infos[args.instances - churn_count:]
+        self.registered = set()
+        self.churn_events = 0
+        self.aiozc = None
+
+    def _make_info(self, index):
+        instance = f"{self.args.instance_prefix}-{index:04d}"
+        properties = {'load': str(self.rng.randint(0, 90)), 'seq': str(index)}
+        # Pad to a random total TXT size, in items short enough for one TXT string each
+        remaining = self.rng.randint(self.args.txt_min, self.args.txt_max)
+        pad = 0
+        while remaining > 0:
+            size = min(remaining, TXT_ITEM_MAX)
+            properties[f'p{pad}'] = ''.join(self.rng.choices(string.ascii_letters, k=size))
+            remaining -= size + len(f'p{pad}') + 2
+            pad += 1
+        return ServiceInfo(self.type_, f"{instance}.{self.type_}",
+                           addresses=[socket.inet_aton(self.address)],
+                           port=10000 + index,
+                           properties=properties,
+                           server=f"{instance}.local.")
+
+    async def start(self):
+        self.aiozc = AsyncZeroconf(interfaces=[self.address])
+        batch = self.args.register_batch
+        for start in range(0, len(self.infos), batch):
+            infos = self.infos[start:start + batch]
+            tasks = [await self.aiozc.async_register_service(info) for info in infos]
+            await asyncio.gather(*tasks)
+            self.registered.update(info.name for info in infos)
+            print(f"Registered {len(self.registered)}/{len(self.infos)} instances")
+
+    async def churn(self, stop_event):
+        if not self.churn_pool:
+            return
+        interval = 1.0 / self.args.churn_rate
+        while not stop_event.is_set():
+            info = self.rng.choice(self.churn_pool)
+            if info.name in self.registered:
+                await await_task(self.aiozc.async_unregister_service(info))
+                self.registered.discard(info.name)
+            else:
+                await await_task(self.aiozc.async_register_service(info))
+                self.registered.add(info.name)
+            self.churn_events += 1
+            try:
+                await asyncio.wait_for(stop_event.wait(), interval)
+            except asyncio.TimeoutError:
+                pass
+
+    async def stop(self):
+        if self.aiozc:
+            await self.aiozc.async_unregister_all_services()
+            await self.aiozc.async_close()
+
+
+async def await_task(coro):
+    """async_(un)register_service return a task to await once the call is scheduled"""
+    task = await coro
+    return await task
+
+
+class DeviceMonitor:
+    """Parse the firmware console into browse cycles and heap/CPU samples"""
+
+    def __init__(self, service_type):
+        service, proto = service_type.rsplit('.', 1)
+        # The component logs type and protocol back to back
+        self.start_line = f"Starting service discovery for {service}{proto}"
+        self.lock = threading.Lock()
+        self.measure_from = None
+        self.cycles = []
+        self.seen = set()
+        self.stats = []
+        self.crashed = False
+        self.lines = 0
+
+    def start_measuring(self):
+        with self.lock:
+            self.measure_from = time.monotonic()
+
+    def feed(self, raw_line):
+        line = ANSI_RE.sub('', raw_line).strip()
+        self.lines += 1
+        if any(marker in line for marker in CRASH_MARKERS):
+            self.crashed = True
+        match = LOG_RE.match(line)
+        if not match:
+            return
+        device_ms, message = int(match.group(1)), match.group(3)
+
+        with self.lock:
+            if self.measure_from is None:
+                return
+            if message.startswith(self.start_line):
+                self.cycles.append({'start_ms': device_ms, 'end_ms': None, 'found': set()})
+            elif message == "Service discovery task completed" and self.cycles:
+                self.cycles[-1]['end_ms'] = device_ms
+            elif self.cycles and (found := FOUND_RE.match(message)):
+                name = found.group(1)
+                self.cycles[-1]['found'].add(name)
+                self.seen.add(name)
+            elif (stats := STATS_RE.match(message)):
+                self.stats.append(tuple(int(v) for v in stats.groups()))
+
+    def pump(self, stream):
+        for raw_line in stream:
+            self.feed(raw_line)
+
+    def report(self, expected):
+        with self.lock:
+            cycles = [c for c in self.cycles if c['end_ms'] is not None]
+            report = {
+                'expected': len(expected),
+                'cycles': len(cycles),
+                'crashed': self.crashed,
+                'completeness': {},
+                'heap_free_min': min((s[0] for s in self.stats), default=None),
+                'heap_low_watermark': min((s[1] for s in self.stats), default=None),
+                'cpu0_load_mean': (round(sum(s[2] for s in self.stats) / len(self.stats), 1)
+                                   if self.stats else None),
+                'cpu0_load_max': max((s[2] for s in self.stats), default=None),
+            }
+            if not cycles or not expected:
+                return report
+
+            ratios = [len(c['found'] & expected) / len(expected) for c in cycles]
+            report['completeness'] = {
+                'cumulative': round(len(expected & self.seen) / len(expected), 4),
+                'per_cycle_mean': round(sum(ratios) / len(ratios), 4),
+                'per_cycle_min': round(min(ratios), 4),
+                'per_cycle_max': round(max(ratios), 4),
+            }
+            return report
+
+
+def check_gates(report, args):
+    """Return the list of violated regression gates"""
+    failures = []
+    if report['crashed']:
+        failures.append("device crashed")
+    if report['cycles'] == 0:
+        failures.append("no browse cycle completed")
+        return failures
+
+    completeness = report['completeness'].get('cumulative', 0.0)
+    if completeness < args.min_completeness:
+        failures.append(f"completeness {completeness:.2%} < {args.min_completeness:.2%}")
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)['results']
+        slack = 1.0 + args.tolerance
+        for key in ('cumulative', 'per_cycle_mean'):
+            current, previous = report['completeness'].get(key), baseline['completeness'].get(key)
+            if previous is not None and current is not None and current < previous / slack:
+                failures.append(f"completeness {key} regressed: {current} < {previous} (-{args.tolerance:.0%})")
+        if baseline.get('cpu0_load_mean') is not None and report['cpu0_load_mean'] is not None \
+                and report['cpu0_load_mean'] > baseline['cpu0_load_mean'] * slack:
+            failures.append(f"cpu0_load_mean regressed: {report['cpu0_load_mean']} > "
+                            f"{baseline['cpu0_load_mean']} (+{args.tolerance:.0%})")
+        if baseline.get('heap_low_watermark') is not None and report['heap_low_watermark'] is not None \
+                and report['heap_low_watermark'] < baseline['heap_low_watermark'] / slack:
+            failures.append(f"heap_low_watermark regressed: {report['heap_low_watermark']} < "
+                            f"{baseline['heap_low_watermark']} (-{args.tolerance:.0%})")
+    return failures
+
+
+async def run_load_test(args):
+    address = args.interface_ip or interface_ipv4(args.interface)
+    print(f"=== Load Test: {args.instances} x {args.service_type} on {args.interface} ({address}) ===")
+
+    fleet = SyntheticServiceFleet(address, args)
+    monitor = DeviceMonitor(args.service_type)
+    device = subprocess.Popen(args.device_cmd.format(interface=args.interface), shell=True,
+                              stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                              text=True, errors='replace')
+    reader = threading.Thread(target=monitor.pump, args=(device.stdout,), daemon=True)
+    reader.start()
+
+    stop_event = asyncio.Event()
+    try:
+        with PacketLoss(args.interface, args.loss):
+            await fleet.start()
+            monitor.start_measuring()
+            churn = asyncio.create_task(fleet.churn(stop_event))
+            print(f"Measuring for {args.duration} s...")
+            deadline = time.monotonic() + args.duration
+            while time.monotonic() < deadline and device.poll() is None and not monitor.crashed:
+                await asyncio.sleep(0.5)
+            stop_event.set()
+            await churn
+    finally:
+        device.terminate()
+        try:
+            device.wait(timeout=5)
+        except subprocess.TimeoutExpired:
+            device.kill()
+        await fleet.stop()
+
+    results = monitor.report(fleet.stable)
+    results['churn_events'] = fleet.churn_events
+    report = {
+        'parameters': {k: v for k, v in vars(args).items() if k not in ('baseline', 'report')},
+        'results': results,
+    }
+    failures = check_gates(results, args)
+    report['failures'] = failures
+
+    print(json.dumps(results, indent=2))
+    if args.report:
+        with open(args.report, 'w') as f:
+            json.dump(report, f, indent=2)
+        print(f"Report written to {args.report}")
+
+    for failure in failures:
+        print(f"❌ {failure}")
+    if not failures:
+        print("✅ All load-test gates passed")
+    return 1 if failures else 0
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description="ESP Service Discovery Test Runner")
+    parser.add_argument('--load', action='store_true',
+                        help="run the synthetic service flood load test instead of the functional tests")
+    load = parser.add_argument_group('load mode')
+    load.add_argument('--interface', default='tap0', help="interface the device is attached to")
+    load.add_argument('--interface-ip', help="address to advertise from (default: first IPv4 of --interface)")
+    load.add_argument('--device-cmd', default=DEFAULT_DEVICE_CMD,
+                      help="command whose output is the device console ({interface} is substituted)")
+    load.add_argument('--service-type', default='_loadtest._tcp', help="must match EXAMPLE_LOAD_TEST_SERVICE")
+    load.add_argument('--instances', type=int, default=200, help="number of synthetic instances")
+    load.add_argument('--instance-prefix', default='load')
+    load.add_argument('--txt-min', type=int, default=16, help="minimum TXT payload per instance (bytes)")
+    load.add_argument('--txt-max', type=int, default=400, help="maximum TXT payload per instance (bytes)")
+    load.add_argument('--churn-rate', type=float, default=0.0, help="register/unregister events per second")
+    load.add_argument('--churn-fraction', type=float, default=0.1, help="share of instances that churn")
+    load.add_argument('--loss', type=float, default=0.0, help="packet loss towards the device (percent)")
+    load.add_argument('--duration', type=int, default=60, help="measurement time after registration (s)")
+    load.add_argument('--register-batch', type=int, default=100, help="instances registered concurrently")
+    load.add_argument('--seed', type=int, default=1, help="seed for TXT contents and churn")
+    load.add_argument('--report', help="write the JSON report to this file")
+    load.add_argument('--min-completeness', type=float, default=0.0,
+                      help="gate: minimum cumulative completeness (0-1)")
+    load.add_argument('--baseline', help="gate: earlier --report to compare completeness, CPU and heap against")
+    load.add_argument('--tolerance', type=float, default=0.2, help="allowed regression against --baseline")
+    return parser.parse_args()
+
 def main():
     print("🚀 ESP Service Discovery Test Runner")
     print("=" * 50)
@@ -281,4 +598,7 @@ def main():
     print("\n🏁 Test completed!")
 
 if __name__ == "__main__":
+    args = parse_args()
+    if args.load:
+        sys.exit(asyncio.run(run_load_test(args)))
     main()
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <string.h>
+#include <inttypes.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
@@ -7,6 +8,7 @@
 #include "esp_eth.h"
 #include "esp_event.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "nvs_flash.h"
 #include "esp_netif.h"
 #include "esp_svc_disc.h"
@@ -20,6 +22,7 @@ static EventGroupHandle_t s_eth_event_group;
 
 static esp_netif_t *eth_netif = NULL;
 
+#if !CONFIG_EXAMPLE_LOAD_TEST
 // Service discovery callback
 static void service_discovered_callback(const char* service_name, 
                                       const char* hostname, 
@@ -41,6 +44,7 @@ static void service_discovered_callback(const char* service_name,
     }
     ESP_LOGI(TAG, "========================");
 }
+#endif
 
 // Ethernet event handler
 static void eth_event_handler(void* arg, esp_event_base_t event_base,
@@ -144,6 +148,74 @@ static esp_err_t ethernet_init(void)
     }
 }
 
+#if CONFIG_EXAMPLE_LOAD_TEST
+// The component already logs every instance; keep the console quiet under load
+static void load_test_callback(const char* service_name, 
+                               const char* hostname, 
+                               uint16_t port,
+                               mdns_txt_item_t* txt_records,
+                               size_t txt_count,
+                               void* user_data)
+{
+}
+
+// Browse the load-test service type back to back
+static void load_test_task(void *pvParameters)
+{
+    char service_type[32];
+    const char* last_dot = strrchr(CONFIG_EXAMPLE_LOAD_TEST_SERVICE, '.');
+    if (!last_dot || last_dot == CONFIG_EXAMPLE_LOAD_TEST_SERVICE) {
+        ESP_LOGE(TAG, "Invalid service format: %s", CONFIG_EXAMPLE_LOAD_TEST_SERVICE);
+        vTaskDelete(NULL);
+        return;
+    }
+    const char* protocol = last_dot + 1;
+    size_t service_len = last_dot - CONFIG_EXAMPLE_LOAD_TEST_SERVICE;
+    strlcpy(service_type, CONFIG_EXAMPLE_LOAD_TEST_SERVICE,
+            service_len < sizeof(service_type) ? service_len + 1 : sizeof(service_type));
+    
+    esp_svc_disc_config_t config = {
+        .service_type = service_type,
+        .protocol = protocol,
+        .timeout_ms = CONFIG_EXAMPLE_LOAD_TEST_TIMEOUT_MS,
+        .callback = load_test_callback,
+        .user_data = NULL
+    };
+    
+    while (1) {
+        esp_err_t err = esp_svc_disc_start(&config);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to start service discovery: %s", esp_err_to_name(err));
+        }
+        
+        // Let the browse and its resolves finish before starting the next cycle
+        do {
+            vTaskDelay(pdMS_TO_TICKS(100));
+        } while (esp_svc_disc_is_running());
+    }
+}
+
+// Log heap and core 0 load (mDNS and lwIP run there) for the load-test harness
+static void stats_task(void *pvParameters)
+{
+    uint32_t last_idle = ulTaskGetIdleRunTimeCounter();
+    int64_t last_us = esp_timer_get_time();
+    
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(CONFIG_EXAMPLE_STATS_INTERVAL_MS));
+        
+        uint32_t idle = ulTaskGetIdleRunTimeCounter();
+        int64_t now_us = esp_timer_get_time();
+        uint32_t idle_pct = (uint32_t)((uint64_t)(idle - last_idle) * 100 / (uint64_t)(now_us - last_us));
+        last_idle = idle;
+        last_us = now_us;
+        
+        ESP_LOGI(TAG, "STATS heap_free=%" PRIu32 " heap_min=%" PRIu32 " cpu0_load=%" PRIu32,
+                 esp_get_free_heap_size(), esp_get_minimum_free_heap_size(),
+                 idle_pct > 100 ? 0 : 100 - idle_pct);
+    }
+}
+#else
 // Task to demonstrate periodic service discovery
 static void discovery_task(void *pvParameters)
 {
@@ -210,6 +282,7 @@ static void discovery_task(void *pvParameters)
         vTaskDelay(pdMS_TO_TICKS(2000));
     }
 }
+#endif
 
 void app_main(void)
 {
@@ -256,9 +329,15 @@ void app_main(void)
         ESP_LOGW(TAG, "Failed to advertise HTTP service: %s", esp_err_to_name(ret));
     }
     
+#if CONFIG_EXAMPLE_LOAD_TEST
+    ESP_LOGI(TAG, "Starting load test for %s...", CONFIG_EXAMPLE_LOAD_TEST_SERVICE);
+    xTaskCreatePinnedToCore(stats_task, "stats_task", 3072, NULL, 2, NULL, 0);
+    xTaskCreate(load_test_task, "load_test_task", 4096, NULL, 5, NULL);
+#else
     // Start discovery task
     ESP_LOGI(TAG, "Starting service discovery task...");
     xTaskCreate(discovery_task, "discovery_task", 4096, NULL, 5, NULL);
+#endif
     
     ESP_LOGI(TAG, "Example setup complete. Discovering services...");
 }